@@ -0,0 +1,48 @@
+#include "FlightState.h"
+
+/// Every allowed phase change. The first transition out of the current phase whose guard passes is taken, so update() is
+/// at most one pass over this table per sample. PHASE_DEPLOYED has no way out, which is what makes the deploy one-shot.
+const FlightTransition FlightStateMachine::transitions[] = {
+	{PHASE_PAD,		PHASE_FLYING,	&FlightStateMachine::liftoff_guard,	ACTION_LIFTOFF},
+	{PHASE_FLYING,	PHASE_DEPLOYED,	&FlightStateMachine::deploy_guard,	ACTION_DEPLOY},
+};
+
+static uint8_t sustain(uint8_t count, bool condition) {
+	if(!condition)
+		return 0;
+	return (count < 255) ? count + 1 : count;
+}
+
+FlightStateMachine::FlightStateMachine(const FlightLimits& limits) : limits(limits) {}
+
+/// Liftoff needs a sustained push from either IMU, so one bad read on the pad can't start the flight.
+bool FlightStateMachine::liftoff_guard(const FlightStateMachine& fsm, const FlightSample&) {
+	return fsm.liftoff_count >= fsm.limits.liftoff_samples;
+}
+
+/// Deployment needs the minimum time since liftoff, the minimum altitude, and sustained low acceleration from either IMU.
+bool FlightStateMachine::deploy_guard(const FlightStateMachine& fsm, const FlightSample& sample) {
+	return (sample.t - fsm.liftoff_time >= fsm.limits.deploy_min_time)
+		&& (sample.alt >= fsm.limits.deploy_min_alt)
+		&& (fsm.deploy_count >= fsm.limits.deploy_samples);
+}
+
+/// Feeds one sample to the state machine. Returns the action the caller must carry out, or ACTION_NONE.
+FlightAction FlightStateMachine::update(const FlightSample& sample) {
+	this->liftoff_count = sustain(this->liftoff_count, (sample.accel_main > this->limits.liftoff_accel) || (sample.accel_backup > this->limits.liftoff_accel));
+	this->deploy_count = sustain(this->deploy_count, (sample.accel_main < this->limits.deploy_accel) || (sample.accel_backup < this->limits.deploy_accel));
+
+	for(uint8_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++) {
+		const FlightTransition& tr = transitions[i];
+		if(tr.from != this->phase || !tr.guard(*this, sample))
+			continue;
+
+		this->phase = tr.to;
+		this->trigger_time = sample.t;
+		if(tr.action == ACTION_LIFTOFF)
+			this->liftoff_time = sample.t;
+		return tr.action;
+	}
+
+	return ACTION_NONE;
+}
@@ -0,0 +1,79 @@
+/**
+ * Flight State Machine
+ * Decides liftoff and experiment deployment from one sample per cycle.
+ *
+ * Note: Deliberately has no Arduino dependencies, so it can be fed recorded sensor traces on a desktop machine.
+ */
+
+#ifndef FLIGHT_STATE_H
+#define FLIGHT_STATE_H
+
+#include <stdint.h>
+
+enum FlightPhase : uint8_t {
+	PHASE_PAD,		// waiting for liftoff
+	PHASE_FLYING,	// liftoff detected, waiting for deployment conditions
+	PHASE_DEPLOYED	// experiment deployed, nothing left to decide
+};
+
+enum FlightAction : uint8_t {
+	ACTION_NONE,
+	ACTION_LIFTOFF,
+	ACTION_DEPLOY
+};
+
+/// One cycle's worth of the data the guards look at.
+struct FlightSample {
+	uint32_t t;			// sample time in ms
+	float accel_main;	// vertical axis acceleration from the main IMU in g
+	float accel_backup;	// vertical axis acceleration from the backup IMU in g
+	float alt;			// altitude above the pad baseline in m
+};
+
+struct FlightLimits {
+	float liftoff_accel;		// g, either IMU above this counts towards liftoff
+	uint8_t liftoff_samples;	// consecutive samples needed above liftoff_accel
+	float deploy_accel;			// g, either IMU below this counts towards deployment
+	uint8_t deploy_samples;		// consecutive samples needed below deploy_accel
+	uint32_t deploy_min_time;	// ms since liftoff before deployment is allowed
+	float deploy_min_alt;		// m above the pad before deployment is allowed
+};
+
+class FlightStateMachine;
+
+typedef bool (*FlightGuard)(const FlightStateMachine&, const FlightSample&);
+
+struct FlightTransition {
+	FlightPhase from;
+	FlightPhase to;
+	FlightGuard guard;
+	FlightAction action;
+};
+
+class FlightStateMachine {
+	private:
+		FlightLimits limits;
+
+		FlightPhase phase = PHASE_PAD;
+		uint32_t liftoff_time = 0;
+		uint32_t trigger_time = 0;
+
+		// Number of consecutive samples meeting each acceleration condition, saturating at 255
+		uint8_t liftoff_count = 0, deploy_count = 0;
+
+		static const FlightTransition transitions[];
+
+		static bool liftoff_guard(const FlightStateMachine&, const FlightSample&);
+		static bool deploy_guard(const FlightStateMachine&, const FlightSample&);
+
+	public:
+		FlightStateMachine(const FlightLimits& limits);
+
+		FlightAction update(const FlightSample& sample);
+
+		FlightPhase get_phase() const { return this->phase; }
+		uint32_t get_liftoff_time() const { return this->liftoff_time; } // ms, valid once past PHASE_PAD
+		uint32_t get_trigger_time() const { return this->trigger_time; } // ms, time of the sample that fired the last action
+};
+
+#endif // FLIGHT_STATE_H
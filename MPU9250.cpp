@@ -53,107 +53,89 @@ void MPU9250::update(MPU9250Dataset& dataset) {
 }
 
 /// Initializes the MPU9250 and onboard AK8963 magnetometer, and sets their sensor resolutions. Returns false if we can't communicate with the MPU9250 or AK8963.
-bool MPU9250::init(uint8_t Ascale = AFS_4G, uint8_t Gscale = GFS_500DPS, uint8_t Mscale = MFS_16BITS, uint8_t Mmode = MMODE_100HZ, bool set_AD0 = false) {
+/// This runs each bring-up stage back to back; to bring up several devices at once, call the stages yourself and overlap their delays.
+bool MPU9250::init(uint8_t Ascale, uint8_t Gscale, uint8_t Mscale, uint8_t Mmode, bool set_AD0) {
+	if(!reset(set_AD0))
+		return false;
+	delay(MPU9250_RESET_DELAY);
+
+	wake();
+	delay(MPU9250_WAKE_DELAY);
+
+	configure(Ascale, Gscale);
+	delay(MPU9250_CONFIG_DELAY);
+
+	return init_mag(Mscale, Mmode);
+}
+
+/// Selects the device address and resets the MPU9250. Returns false if it doesn't answer. Wait MPU9250_RESET_DELAY before wake().
+bool MPU9250::reset(bool set_AD0) {
 	if(set_AD0)
 		this->MPU9250_ADDRESS = 0x69;
-		
-	if(readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0x71) {
-		// reset device
-		writeByte(this->MPU9250_ADDRESS, PWR_MGMT_1, 0x80); // Write a one to bit 7 reset bit; toggle reset device
-		delay(100);
-
-		// get stable time source; Auto select clock source to be PLL gyroscope reference if ready
-		// else use the internal oscillator, bits 2:0 = 001
-		writeByte(this->MPU9250_ADDRESS, PWR_MGMT_1, 0x01);
-		writeByte(this->MPU9250_ADDRESS, PWR_MGMT_2, 0x00);
-		delay(200);
-
-		// Configure Gyro and Thermometer
-		// Disable FSYNC and set thermometer and gyro bandwidth to 41 and 42 Hz, respectively;
-		// minimum delay time for this setting is 5.9 ms, which means sensor fusion update rates cannot
-		// be higher than 1 / 0.0059 = 170 Hz
-		// DLPF_CFG = bits 2:0 = 011; this limits the sample rate to 1000 Hz for both
-		// With the MPU9250, it is possible to get gyro sample rates of 32 kHz (!), 8 kHz, or 1 kHz
-		writeByte(this->MPU9250_ADDRESS, CONFIG, 0x03);
-
-		// Set sample rate = gyroscope output rate/(1 + SMPLRT_DIV)
-		writeByte(this->MPU9250_ADDRESS, SMPLRT_DIV, 0x04);  // Use a 200 Hz rate; a rate consistent with the filter update rate
-		// determined inset in CONFIG above
-
-		// Set gyroscope full scale range
-		// Range selects FS_SEL and AFS_SEL are 0 - 3, so 2-bit values are left-shifted into positions 4:3
-		uint8_t c = readByte(this->MPU9250_ADDRESS, GYRO_CONFIG); // get current GYRO_CONFIG register value
-		// c = c & ~0xE0; // Clear self-test bits [7:5]
-		c = c & ~0x02; // Clear Fchoice bits [1:0]
-		c = c & ~0x18; // Clear AFS bits [4:3]
-		c = c | Gscale << 3; // Set full scale range for the gyro
-		// c =| 0x00; // Set Fchoice for the gyro to 11 by writing its inverse to bits 1:0 of GYRO_CONFIG
-		writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG, c ); // Write new GYRO_CONFIG value to register
-
-		// Set accelerometer full-scale range configuration
-		c = readByte(this->MPU9250_ADDRESS, ACCEL_CONFIG); // get current ACCEL_CONFIG register value
-		// c = c & ~0xE0; // Clear self-test bits [7:5]
-		c = c & ~0x18;  // Clear AFS bits [4:3]
-		c = c | Ascale << 3; // Set full scale range for the accelerometer
-		writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, c); // Write new ACCEL_CONFIG register value
-
-		// Set accelerometer sample rate configuration
-		// It is possible to get a 4 kHz sample rate from the accelerometer by choosing 1 for
-		// accel_fchoice_b bit [3]; in this case the bandwidth is 1.13 kHz
-		c = readByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2); // get current ACCEL_CONFIG2 register value
-		c = c & ~0x0F; // Clear accel_fchoice_b (bit 3) and A_DLPFG (bits [2:0])
-		c = c | 0x03;  // Set accelerometer rate to 1 kHz and bandwidth to 41 Hz
-		writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2, c); // Write new ACCEL_CONFIG2 register value
-
-		// The accelerometer, gyro, and thermometer are set to 1 kHz sample rates,
-		// but all these rates are further reduced by a factor of 5 to 200 Hz because of the SMPLRT_DIV setting
-
-		// Configure Interrupts and Bypass Enable
-		// Set interrupt pin active high, push-pull, hold interrupt pin level HIGH until interrupt cleared,
-		// clear on read of INT_STATUS, and enable I2C_BYPASS_EN so additional chips
-		// can join the I2C bus and all can be controlled by the Arduino as master
-		writeByte(this->MPU9250_ADDRESS, INT_PIN_CFG, 0x22);
-		writeByte(this->MPU9250_ADDRESS, INT_ENABLE, 0x01);  // Enable data ready (bit 0) interrupt
-		delay(100);
-	} else
-		return false;
 
-	// And now for the magnetometer
-	if(readByte(AK8963_ADDRESS, AK8963_WHO_AM_I) == 0x48) {
-		// First extract the factory calibration for each magnetometer axis
-		uint8_t rawData[3];  // x/y/z gyro calibration data stored here
-		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x00); // Power down magnetometer
-		delay(10);
-		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x0F); // Enter Fuse ROM access mode
-		delay(10);
-		readBytes(AK8963_ADDRESS, AK8963_ASAX, 3, &rawData[0]);  // Read the x-, y-, and z-axis calibration values
-		this->magCalibration[0] = (float)(rawData[0] - 128)/256. + 1.;   // Return x-axis sensitivity adjustment values, etc.
-		this->magCalibration[1] = (float)(rawData[1] - 128)/256. + 1.;
-		this->magCalibration[2] = (float)(rawData[2] - 128)/256. + 1.;
-		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x00); // Power down magnetometer
-		delay(10);
-		// Configure the magnetometer for continuous read and highest resolution
-		// set Mscale bit 4 to 1 (0) to enable 16 (14) bit resolution in CNTL register,
-		// and enable continuous mode data acquisition Mmode (bits [3:0]), 0010 for 8 Hz and 0110 for 100 Hz sample rates
-		writeByte(AK8963_ADDRESS, AK8963_CNTL, Mscale << 4 | Mmode); // Set magnetometer data resolution and sample ODR
-		delay(10);
-	} else
-		/*Serial.println((readByte(AK8963_ADDRESS, AK8963_WHO_AM_I) == 0x48));
-		Serial.println(readByte(AK8963_ADDRESS, AK8963_WHO_AM_I));
-		Serial.println((readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0x71));
-		Serial.println(readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250));*/
+	if(readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250) != 0x71)
 		return false;
 
-	switch (Mscale) {
-		// Possible magnetometer scales (and their register bit settings) are:
-		// 14 bit resolution (0) and 16 bit resolution (1)
-		case MFS_14BITS:
-			this->mRes = 10.*4912./8190.; // Proper scale to return milliGauss
-			break;
-		case MFS_16BITS:
-			this->mRes = 10.*4912./32760.0; // Proper scale to return milliGauss
-			break;
-	}
+	writeByte(this->MPU9250_ADDRESS, PWR_MGMT_1, 0x80); // Write a one to bit 7 reset bit; toggle reset device
+	return true;
+}
+
+/// Brings the MPU9250 out of reset. Wait MPU9250_WAKE_DELAY before self testing or configuring.
+void MPU9250::wake() {
+	// get stable time source; Auto select clock source to be PLL gyroscope reference if ready
+	// else use the internal oscillator, bits 2:0 = 001
+	writeByte(this->MPU9250_ADDRESS, PWR_MGMT_1, 0x01);
+	writeByte(this->MPU9250_ADDRESS, PWR_MGMT_2, 0x00);
+}
+
+/// Sets the accel and gyro ranges, filters, sample rate and data ready interrupt. Wait MPU9250_CONFIG_DELAY before reading data.
+void MPU9250::configure(uint8_t Ascale, uint8_t Gscale) {
+	// Configure Gyro and Thermometer
+	// Disable FSYNC and set thermometer and gyro bandwidth to 41 and 42 Hz, respectively;
+	// minimum delay time for this setting is 5.9 ms, which means sensor fusion update rates cannot
+	// be higher than 1 / 0.0059 = 170 Hz
+	// DLPF_CFG = bits 2:0 = 011; this limits the sample rate to 1000 Hz for both
+	// With the MPU9250, it is possible to get gyro sample rates of 32 kHz (!), 8 kHz, or 1 kHz
+	writeByte(this->MPU9250_ADDRESS, CONFIG, 0x03);
+
+	// Set sample rate = gyroscope output rate/(1 + SMPLRT_DIV)
+	writeByte(this->MPU9250_ADDRESS, SMPLRT_DIV, 0x04);  // Use a 200 Hz rate; a rate consistent with the filter update rate
+	// determined inset in CONFIG above
+
+	// Set gyroscope full scale range
+	// Range selects FS_SEL and AFS_SEL are 0 - 3, so 2-bit values are left-shifted into positions 4:3
+	uint8_t c = readByte(this->MPU9250_ADDRESS, GYRO_CONFIG); // get current GYRO_CONFIG register value
+	// c = c & ~0xE0; // Clear self-test bits [7:5]
+	c = c & ~0x02; // Clear Fchoice bits [1:0]
+	c = c & ~0x18; // Clear AFS bits [4:3]
+	c = c | Gscale << 3; // Set full scale range for the gyro
+	// c =| 0x00; // Set Fchoice for the gyro to 11 by writing its inverse to bits 1:0 of GYRO_CONFIG
+	writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG, c ); // Write new GYRO_CONFIG value to register
+
+	// Set accelerometer full-scale range configuration
+	c = readByte(this->MPU9250_ADDRESS, ACCEL_CONFIG); // get current ACCEL_CONFIG register value
+	// c = c & ~0xE0; // Clear self-test bits [7:5]
+	c = c & ~0x18;  // Clear AFS bits [4:3]
+	c = c | Ascale << 3; // Set full scale range for the accelerometer
+	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, c); // Write new ACCEL_CONFIG register value
+
+	// Set accelerometer sample rate configuration
+	// It is possible to get a 4 kHz sample rate from the accelerometer by choosing 1 for
+	// accel_fchoice_b bit [3]; in this case the bandwidth is 1.13 kHz
+	c = readByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2); // get current ACCEL_CONFIG2 register value
+	c = c & ~0x0F; // Clear accel_fchoice_b (bit 3) and A_DLPFG (bits [2:0])
+	c = c | 0x03;  // Set accelerometer rate to 1 kHz and bandwidth to 41 Hz
+	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2, c); // Write new ACCEL_CONFIG2 register value
+
+	// The accelerometer, gyro, and thermometer are set to 1 kHz sample rates,
+	// but all these rates are further reduced by a factor of 5 to 200 Hz because of the SMPLRT_DIV setting
+
+	// Configure Interrupts and Bypass Enable
+	// Set interrupt pin active high, push-pull, hold interrupt pin level HIGH until interrupt cleared,
+	// clear on read of INT_STATUS, and enable I2C_BYPASS_EN so additional chips
+	// can join the I2C bus and all can be controlled by the Arduino as master
+	writeByte(this->MPU9250_ADDRESS, INT_PIN_CFG, 0x22);
+	writeByte(this->MPU9250_ADDRESS, INT_ENABLE, 0x01);  // Enable data ready (bit 0) interrupt
 
 	switch (Gscale) {
 		// Possible gyro scales (and their register bit settings) are:
@@ -190,26 +172,72 @@ bool MPU9250::init(uint8_t Ascale = AFS_4G, uint8_t Gscale = GFS_500DPS, uint8_t
 			this->aRes = 16.0/32768.0;
 			break;
 	}
+}
+
+/// Initializes the AK8963 magnetometer. Returns false if we can't communicate with it.
+bool MPU9250::init_mag(uint8_t Mscale, uint8_t Mmode) {
+	if(readByte(AK8963_ADDRESS, AK8963_WHO_AM_I) == 0x48) {
+		// First extract the factory calibration for each magnetometer axis
+		uint8_t rawData[3];  // x/y/z gyro calibration data stored here
+		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x00); // Power down magnetometer
+		delay(10);
+		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x0F); // Enter Fuse ROM access mode
+		delay(10);
+		readBytes(AK8963_ADDRESS, AK8963_ASAX, 3, &rawData[0]);  // Read the x-, y-, and z-axis calibration values
+		this->magCalibration[0] = (float)(rawData[0] - 128)/256. + 1.;   // Return x-axis sensitivity adjustment values, etc.
+		this->magCalibration[1] = (float)(rawData[1] - 128)/256. + 1.;
+		this->magCalibration[2] = (float)(rawData[2] - 128)/256. + 1.;
+		writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x00); // Power down magnetometer
+		delay(10);
+		// Configure the magnetometer for continuous read and highest resolution
+		// set Mscale bit 4 to 1 (0) to enable 16 (14) bit resolution in CNTL register,
+		// and enable continuous mode data acquisition Mmode (bits [3:0]), 0010 for 8 Hz and 0110 for 100 Hz sample rates
+		writeByte(AK8963_ADDRESS, AK8963_CNTL, Mscale << 4 | Mmode); // Set magnetometer data resolution and sample ODR
+		delay(10);
+	} else
+		/*Serial.println((readByte(AK8963_ADDRESS, AK8963_WHO_AM_I) == 0x48));
+		Serial.println(readByte(AK8963_ADDRESS, AK8963_WHO_AM_I));
+		Serial.println((readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0x71));
+		Serial.println(readByte(this->MPU9250_ADDRESS, WHO_AM_I_MPU9250));*/
+		return false;
+
+	switch (Mscale) {
+		// Possible magnetometer scales (and their register bit settings) are:
+		// 14 bit resolution (0) and 16 bit resolution (1)
+		case MFS_14BITS:
+			this->mRes = 10.*4912./8190.; // Proper scale to return milliGauss
+			break;
+		case MFS_16BITS:
+			this->mRes = 10.*4912./32760.0; // Proper scale to return milliGauss
+			break;
+	}
 
 	return true;
 }
 
 /// Accelerometer and gyroscope self test; check calibration wrt factory settings
 void MPU9250::self_test(float* results) { // Should return percent deviation from factory trim values, +/- 14 or less deviation is a pass
-	uint8_t rawData[6] = {0, 0, 0, 0, 0, 0};
-	uint8_t selfTest[6];
-	int32_t gAvg[3] = {0}, aAvg[3] = {0}, aSTAvg[3] = {0}, gSTAvg[3] = {0};
-	float factoryTrim[6];
-	uint8_t FS = 0;
+	MPU9250SelfTest st;
 
-	writeByte(this->MPU9250_ADDRESS, SMPLRT_DIV, 0x00);    // Set gyro sample rate to 1 kHz
-	writeByte(this->MPU9250_ADDRESS, CONFIG, 0x02);        // Set gyro sample rate to 1 kHz and DLPF to 92 Hz
-	writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG, FS<<3);  // Set full scale range for the gyro to 250 dps
-	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2, 0x02); // Set accelerometer rate to 1 kHz and bandwidth to 92 Hz
-	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, FS<<3); // Set full scale range for the accelerometer to 2 g
+	self_test_begin(st);
+	delay(MPU9250_SELF_TEST_DELAY);  // Delay a while to let the device stabilize
 
-	for( int ii = 0; ii < 200; ii++) {  // get average current values of gyro and acclerometer
+	self_test_stimulus(st);
+	delay(MPU9250_SELF_TEST_DELAY);  // Delay a while to let the device stabilize
+
+	self_test_end(st, results);
+}
 
+/// Averages 200 readings of the accelerometer and gyro at their current settings.
+void MPU9250::average_raw(int32_t* aAvg, int32_t* gAvg) {
+	uint8_t rawData[6] = {0, 0, 0, 0, 0, 0};
+
+	for(int i = 0; i < 3; i++) {
+		aAvg[i] = 0;
+		gAvg[i] = 0;
+	}
+
+	for( int ii = 0; ii < 200; ii++) {  // get average values of gyro and acclerometer
 		readBytes(this->MPU9250_ADDRESS, ACCEL_XOUT_H, 6, &rawData[0]);        // Read the six raw data registers into data array
 		aAvg[0] += (int16_t)(((int16_t)rawData[0] << 8) | rawData[1]) ;  // Turn the MSB and LSB into a signed 16-bit value
 		aAvg[1] += (int16_t)(((int16_t)rawData[2] << 8) | rawData[3]) ;
@@ -221,37 +249,45 @@ void MPU9250::self_test(float* results) { // Should return percent deviation fro
 		gAvg[2] += (int16_t)(((int16_t)rawData[4] << 8) | rawData[5]) ;
 	}
 
-	for (int ii =0; ii < 3; ii++) {  // Get average of 200 values and store as average current readings
+	for (int ii =0; ii < 3; ii++) {  // Get average of 200 values
 		aAvg[ii] /= 200;
 		gAvg[ii] /= 200;
 	}
+}
+
+/// Self test, first stage: averages the normal readings, then turns on the self-test stimulus.
+/// Wait MPU9250_SELF_TEST_DELAY before self_test_stimulus().
+void MPU9250::self_test_begin(MPU9250SelfTest& st) {
+	uint8_t FS = 0;
+
+	writeByte(this->MPU9250_ADDRESS, SMPLRT_DIV, 0x00);    // Set gyro sample rate to 1 kHz
+	writeByte(this->MPU9250_ADDRESS, CONFIG, 0x02);        // Set gyro sample rate to 1 kHz and DLPF to 92 Hz
+	writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG, FS<<3);  // Set full scale range for the gyro to 250 dps
+	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG2, 0x02); // Set accelerometer rate to 1 kHz and bandwidth to 92 Hz
+	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, FS<<3); // Set full scale range for the accelerometer to 2 g
+
+	average_raw(st.aAvg, st.gAvg); // average current readings
 
 	// Configure the accelerometer for self-test
 	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, 0xE0); // Enable self test on all three axes and set accelerometer range to +/- 2 g
 	writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG,  0xE0); // Enable self test on all three axes and set gyro range to +/- 250 degrees/s
-	delay(25);  // Delay a while to let the device stabilize
-
-	for( int ii = 0; ii < 200; ii++) {  // get average self-test values of gyro and acclerometer
-		readBytes(this->MPU9250_ADDRESS, ACCEL_XOUT_H, 6, &rawData[0]);  // Read the six raw data registers into data array
-		aSTAvg[0] += (int16_t)(((int16_t)rawData[0] << 8) | rawData[1]) ;  // Turn the MSB and LSB into a signed 16-bit value
-		aSTAvg[1] += (int16_t)(((int16_t)rawData[2] << 8) | rawData[3]) ;
-		aSTAvg[2] += (int16_t)(((int16_t)rawData[4] << 8) | rawData[5]) ;
-
-		readBytes(this->MPU9250_ADDRESS, GYRO_XOUT_H, 6, &rawData[0]);  // Read the six raw data registers sequentially into data array
-		gSTAvg[0] += (int16_t)(((int16_t)rawData[0] << 8) | rawData[1]) ;  // Turn the MSB and LSB into a signed 16-bit value
-		gSTAvg[1] += (int16_t)(((int16_t)rawData[2] << 8) | rawData[3]) ;
-		gSTAvg[2] += (int16_t)(((int16_t)rawData[4] << 8) | rawData[5]) ;
-	}
+}
 
-	for (int ii =0; ii < 3; ii++) {  // Get average of 200 values and store as average self-test readings
-		aSTAvg[ii] /= 200;
-		gSTAvg[ii] /= 200;
-	}
+/// Self test, second stage: averages the readings under stimulus, then turns the stimulus off.
+/// Wait MPU9250_SELF_TEST_DELAY before self_test_end().
+void MPU9250::self_test_stimulus(MPU9250SelfTest& st) {
+	average_raw(st.aSTAvg, st.gSTAvg); // average self-test readings
 
 	// Configure the gyro and accelerometer for normal operation
 	writeByte(this->MPU9250_ADDRESS, ACCEL_CONFIG, 0x00);
 	writeByte(this->MPU9250_ADDRESS, GYRO_CONFIG,  0x00);
-	delay(25);  // Delay a while to let the device stabilize
+}
+
+/// Self test, last stage: compares the stimulus response against the factory trim. Fills results with float[6].
+void MPU9250::self_test_end(MPU9250SelfTest& st, float* results) {
+	uint8_t selfTest[6];
+	float factoryTrim[6];
+	uint8_t FS = 0;
 
 	// Retrieve accelerometer and gyro factory Self-Test Code from USR_Reg
 	selfTest[0] = readByte(this->MPU9250_ADDRESS, SELF_TEST_X_ACCEL); // X-axis accel self-test results
@@ -272,8 +308,8 @@ void MPU9250::self_test(float* results) { // Should return percent deviation fro
 	// Report results as a ratio of (STR - FT)/FT; the change from Factory Trim of the Self-Test Response
 	// To get percent, must multiply by 100
 	for (int i = 0; i < 3; i++) {
-		results[i]   = 100.0*((float)(aSTAvg[i] - aAvg[i]))/factoryTrim[i] - 100.;   // Report percent differences
-		results[i+3] = 100.0*((float)(gSTAvg[i] - gAvg[i]))/factoryTrim[i+3] - 100.; // Report percent differences
+		results[i]   = 100.0*((float)(st.aSTAvg[i] - st.aAvg[i]))/factoryTrim[i] - 100.;   // Report percent differences
+		results[i+3] = 100.0*((float)(st.gSTAvg[i] - st.gAvg[i]))/factoryTrim[i+3] - 100.; // Report percent differences
 	}
 }
 
@@ -181,10 +181,21 @@
 #define MMODE_8HZ	0x02
 #define MMODE_100HZ	0x06
 
+// Settle times in ms required after each bring-up stage
+#define MPU9250_RESET_DELAY		100
+#define MPU9250_WAKE_DELAY		200
+#define MPU9250_CONFIG_DELAY	100
+#define MPU9250_SELF_TEST_DELAY	25
+
 struct MPU9250Dataset {
 	float Ax, Ay, Az, Gx, Gy, Gz, T;
 };
 
+/// Raw averages carried between the self test stages.
+struct MPU9250SelfTest {
+	int32_t aAvg[3], gAvg[3], aSTAvg[3], gSTAvg[3];
+};
+
 class MPU9250 {
 	private:
 		// Scale resolutions per LSB for the sensors
@@ -199,6 +210,8 @@ class MPU9250 {
 		uint8_t readByte(uint8_t, uint8_t);
 		void readBytes(uint8_t, uint8_t, uint8_t, uint8_t*);
 
+		void average_raw(int32_t* aAvg, int32_t* gAvg); // int32_t[3], int32_t[3]
+
 	public:
 		bool ready();
 		void update(MPU9250Dataset&);
@@ -206,6 +219,15 @@ class MPU9250 {
 		bool init(uint8_t Ascale = AFS_4G, uint8_t Gscale = GFS_500DPS, uint8_t Mscale = MFS_16BITS, uint8_t Mmode = MMODE_100HZ, bool set_AD0 = false);
 		void self_test(float* results); // float[6]
 
+		// init() and self_test() broken into their stages, so several devices can be brought up with their delays overlapped
+		bool reset(bool set_AD0 = false);
+		void wake();
+		void configure(uint8_t Ascale, uint8_t Gscale);
+		bool init_mag(uint8_t Mscale, uint8_t Mmode);
+		void self_test_begin(MPU9250SelfTest& st);
+		void self_test_stimulus(MPU9250SelfTest& st);
+		void self_test_end(MPU9250SelfTest& st, float* results); // float[6]
+
 		void calibrate_still_bias(float* newAccelBias, float* newGyroBias); // float[3], float[3]
 //		void calibrate_mag_bias(float* newMagBias, float* newMagScale, uint8_t Mmode); // float[3], float[3]
 		void set_bias(float* newAccelBias, float* newGyroBias, float* newMagBias); // float[3], float[3], float[3]
@@ -0,0 +1,48 @@
+#include "TelemetryLog.h"
+
+static const char str_space = ' ';
+
+/// Writes one space separated sample line, in the column order tools/tecs_log.cpp expects. Returns the bytes written.
+size_t logSample(Print& out, uint32_t cycle, float t, const MPU9250Dataset& main, const MPU9250Dataset& backup, const BaroData& baro, double alt, uint32_t cycle_ms) {
+	size_t n = 0;
+	n += out.print(cycle);
+	n += out.print(str_space);
+	n += out.print(t, 3);
+	n += out.print(str_space);
+	n += out.print(main.Ax, 2);
+	n += out.print(str_space);
+	n += out.print(main.Ay, 2);
+	n += out.print(str_space);
+	n += out.print(main.Az, 2);
+	n += out.print(str_space);
+	n += out.print(main.Gx, 1);
+	n += out.print(str_space);
+	n += out.print(main.Gy, 1);
+	n += out.print(str_space);
+	n += out.print(main.Gz, 1);
+	n += out.print(str_space);
+	n += out.print(main.T, 1);
+	n += out.print(str_space);
+	n += out.print(backup.Ax, 2);
+	n += out.print(str_space);
+	n += out.print(backup.Ay, 2);
+	n += out.print(str_space);
+	n += out.print(backup.Az, 2);
+	n += out.print(str_space);
+	n += out.print(backup.Gx, 1);
+	n += out.print(str_space);
+	n += out.print(backup.Gy, 1);
+	n += out.print(str_space);
+	n += out.print(backup.Gz, 1);
+	n += out.print(str_space);
+	n += out.print(backup.T, 1);
+	n += out.print(str_space);
+	n += out.print(baro.P, 1);
+	n += out.print(str_space);
+	n += out.print(baro.T, 1);
+	n += out.print(str_space);
+	n += out.print(alt, 1);
+	n += out.print(str_space);
+	n += out.println(cycle_ms);
+	return n;
+}
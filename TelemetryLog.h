@@ -0,0 +1,20 @@
+/**
+ * Telemetry Log Formatting
+ * Writes one sample line of the flight log. Kept out of the sketch so the host benchmark in tools/ times the same code.
+ */
+
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <Arduino.h>
+
+#include "MPU9250.h"
+
+struct BaroData {
+	float P; // barometer pressure
+	float T; // barometer temperature
+};
+
+size_t logSample(Print& out, uint32_t cycle, float t, const MPU9250Dataset& main, const MPU9250Dataset& backup, const BaroData& baro, double alt, uint32_t cycle_ms);
+
+#endif // TELEMETRY_LOG_H
@@ -12,9 +12,12 @@
 #include <SD.h>
 
 #include "MPU9250.h"
+#include "FlightState.h"
+#include "TelemetryLog.h"
 
 //#define SERIAL_DEBUG /// Enables debugging to the serial console. ENSURE THIS IS COMMENTED OUT BEFORE FLIGHT. Seriously. See my rant in loop() for more info.
 #define BUZZER_DEBUG
+//#define CYCLE_PROFILE /// Times each stage of loop() and logs a "# PROFILE" line every PROFILE_REPORT_CYCLES cycles. Adds a few micros() calls per cycle; leave it off for flight.
 
 const float ACCEL_BIAS_X_MAIN = 0.011;
 const float ACCEL_BIAS_Y_MAIN = 0.013;
@@ -36,10 +39,19 @@ const float EXPERIMENT_MAGNITUDE_THRESHOLD = 0.1;*/
 const float LIFTOFF_POS_Y_THRESHOLD = 2.0;
 const float EXPERIMENT_POS_Y_THRESHOLD = 0.1;
 
+/// Deployment sanity checks. At ~34 Hz, 3 samples is just under 100ms of agreement. The time and altitude minimums
+/// should be revisited against the motor's burn time and the sim's altitude at burnout before flight.
+const uint8_t LIFTOFF_SUSTAIN_SAMPLES = 3;
+const uint8_t EXPERIMENT_SUSTAIN_SAMPLES = 3;
+const uint32_t EXPERIMENT_MIN_TIME = 4000; // ms after liftoff
+const float EXPERIMENT_MIN_ALTITUDE_FT = 500.f;
+
 const uint8_t FILTER_SIZE = 0;
 
 const uint8_t FILE_FLUSH_THRESHOLD = 30;
 
+const uint8_t PROFILE_REPORT_CYCLES = 100;
+
 const uint8_t RELAY_ONE_PIN = 5;
 const uint8_t RELAY_TWO_PIN = 6;
 const uint8_t RPI_SIGNAL_PIN = 7;
@@ -49,6 +61,12 @@ const uint8_t CHIP_SELECT_PIN = 10;
 
 const float M_TO_FT = 3.28084;
 
+const FlightLimits flight_limits = {
+	LIFTOFF_POS_Y_THRESHOLD, LIFTOFF_SUSTAIN_SAMPLES,
+	EXPERIMENT_POS_Y_THRESHOLD, EXPERIMENT_SUSTAIN_SAMPLES,
+	EXPERIMENT_MIN_TIME, EXPERIMENT_MIN_ALTITUDE_FT / M_TO_FT
+};
+
 const uint16_t ERR_BEEP_TIMEOUT		= 5000;
 const uint16_t WARN_BEEP_TIMEOUT	= 2000;
 
@@ -77,11 +95,6 @@ const char str_space = ' ';
 
 int16_t buzzer_timer = 0;
 
-struct BaroData {
-	float P; // barometer pressure
-	float T; // barometer temperature
-};
-
 struct FilteredDataset {
 	MPU9250Dataset mpu_main;
 	MPU9250Dataset mpu_backup;
@@ -92,6 +105,7 @@ struct FilteredDataset {
 MPU9250 imu9250_main;
 MPU9250 imu9250_backup;
 SFE_BMP180 pressure;
+FlightStateMachine flight(flight_limits);
 
 double baseline; // baseline pressure
 uint32_t last_time;
@@ -108,6 +122,81 @@ uint8_t filter_index = 0;
 
 bool flying = false;
 
+/// Stages of loop() timed by the profiler, in the order they run. The names are what ends up in the log line.
+enum ProfileStage : uint8_t { PROF_WAIT, PROF_MPU_MAIN, PROF_MPU_BACKUP, PROF_BARO, PROF_SERIAL, PROF_DECIDE, PROF_LOG, PROF_FLUSH, PROF_COUNT };
+
+#ifdef CYCLE_PROFILE
+const char* const profile_names[PROF_COUNT] = {"wait", "mpu_main", "mpu_backup", "baro", "serial", "decide", "log", "flush"};
+
+uint32_t prof_mark;
+uint32_t prof_total_us[PROF_COUNT];
+uint32_t prof_max_us[PROF_COUNT];
+uint32_t prof_log_bytes = 0;
+uint8_t prof_cycles = 0;
+
+/// Starts timing a new cycle.
+void profileBegin() {
+	prof_mark = micros();
+}
+
+/// Charges the time since the last mark to `stage` and starts the next one.
+void profileMark(uint8_t stage) {
+	uint32_t t = micros();
+	uint32_t elapsed = t - prof_mark;
+	prof_total_us[stage] += elapsed;
+	if(elapsed > prof_max_us[stage])
+		prof_max_us[stage] = elapsed;
+	prof_mark = t;
+}
+
+/// Adds the bytes written by one log line to this window's total.
+void profileBytes(size_t bytes) {
+	prof_log_bytes += bytes;
+}
+
+/// Writes the averaged stage timings and log bytes per sample, then starts a new window. Format:
+/// # <t> PROFILE cycles=<n> bytes=<per sample> <stage>=<avg us>/<max us> ...
+void profileReport() {
+	if(++prof_cycles < PROFILE_REPORT_CYCLES)
+		return;
+
+	if (data_file) {
+		data_file.print(F("# ")); data_file.print((float)(millis() - start_time) / 1000.f, 3); data_file.print(F(" PROFILE cycles="));
+		data_file.print(prof_cycles);
+		data_file.print(F(" bytes="));
+		data_file.print(prof_log_bytes / prof_cycles);
+		for(uint8_t i = 0; i < PROF_COUNT; i++) {
+			data_file.print(str_space);
+			data_file.print(profile_names[i]);
+			data_file.print('=');
+			data_file.print(prof_total_us[i] / prof_cycles);
+			data_file.print('/');
+			data_file.print(prof_max_us[i]);
+		}
+		data_file.println();
+	}
+
+	#ifdef SERIAL_DEBUG
+	Serial.print(F("profile over ")); Serial.print(prof_cycles); Serial.print(F(" cycles, ")); Serial.print(prof_log_bytes / prof_cycles); Serial.println(F(" bytes/sample"));
+	for(uint8_t i = 0; i < PROF_COUNT; i++) {
+		Serial.print(profile_names[i]); Serial.print(F(": avg ")); Serial.print(prof_total_us[i] / prof_cycles); Serial.print(F(" us, max ")); Serial.print(prof_max_us[i]); Serial.println(F(" us"));
+	}
+	#endif // SERIAL_DEBUG
+
+	for(uint8_t i = 0; i < PROF_COUNT; i++) {
+		prof_total_us[i] = 0;
+		prof_max_us[i] = 0;
+	}
+	prof_log_bytes = 0;
+	prof_cycles = 0;
+}
+#else
+inline void profileBegin() {}
+inline void profileMark(uint8_t) {}
+inline void profileBytes(size_t) {}
+inline void profileReport() {}
+#endif // CYCLE_PROFILE
+
 void warning(char warn) {
 	switch(warn) {
 	case WARN_BMP180_TEMP_START_FAIL:
@@ -219,15 +308,19 @@ void error(char err) {
 	}
 }
 
-void deployExperiment() {
+/// `sample_us` is the micros() timestamp of the sample that satisfied the trigger, so the logged latency covers everything
+/// from reading the IMUs to driving the relays.
+void deployExperiment(uint32_t sample_us) {
 	// pull pins LOW to activate the relays
 	digitalWrite(RELAY_ONE_PIN, LOW);
 	digitalWrite(RELAY_TWO_PIN, LOW);
+	uint32_t relay_us = micros();
 	if (data_file) {
-		data_file.print(F("# ")); data_file.print((float)(millis() - start_time) / 1000.f, 3); data_file.println(F(" EXPERIMENT DEPLOYED!")); data_file.flush();
+		data_file.print(F("# ")); data_file.print((float)(millis() - start_time) / 1000.f, 3); data_file.print(F(" EXPERIMENT DEPLOYED! latency us: ")); data_file.println(relay_us - sample_us); data_file.flush();
 	}
 	#ifdef SERIAL_DEBUG
 	Serial.println("##### EXPERIMENT DEPLOYED #####");
+	Serial.print(F("trigger to relay latency: ")); Serial.print(relay_us - sample_us); Serial.println(F(" us"));
 	#endif // SERIAL_DEBUG
 	#ifdef BUZZER_DEBUG
 	digitalWrite(BUZZER_PIN, HIGH);
@@ -250,6 +343,34 @@ void liftoff() {
 	#endif
 }
 
+/// Waits until `ms` milliseconds have passed since `since`, for settle delays that other work was overlapped with.
+void settle(uint32_t since, uint16_t ms) {
+	while((millis() - since) < ms) {}
+}
+
+/// Logs an IMU's self test deviations from factory trim (percent, +/- 14 or less is a pass).
+void reportSelfTest(const __FlashStringHelper* name, float* results) {
+	if (data_file) {
+		data_file.print(F("# ")); data_file.print((float)(millis() - start_time) / 1000.f, 3); data_file.print(str_space); data_file.print(name); data_file.print(F(" self test: "));
+		data_file.print(results[0],1); data_file.print(str_space);
+		data_file.print(results[1],1); data_file.print(str_space);
+		data_file.print(results[2],1); data_file.print(str_space);
+		data_file.print(results[3],1); data_file.print(str_space);
+		data_file.print(results[4],1); data_file.print(str_space);
+		data_file.println(results[5],1);
+		data_file.flush();
+	}
+
+	#ifdef SERIAL_DEBUG
+	Serial.print(name); Serial.print(F(" x-axis self test: acceleration trim within ")); Serial.print(results[0],1); Serial.println(F("% of factory value"));
+	Serial.print(name); Serial.print(F(" y-axis self test: acceleration trim within ")); Serial.print(results[1],1); Serial.println(F("% of factory value"));
+	Serial.print(name); Serial.print(F(" z-axis self test: acceleration trim within ")); Serial.print(results[2],1); Serial.println(F("% of factory value"));
+	Serial.print(name); Serial.print(F(" x-axis self test: gyration trim within ")); Serial.print(results[3],1); Serial.println(F("% of factory value"));
+	Serial.print(name); Serial.print(F(" y-axis self test: gyration trim within ")); Serial.print(results[4],1); Serial.println(F("% of factory value"));
+	Serial.print(name); Serial.print(F(" z-axis self test: gyration trim within ")); Serial.print(results[5],1); Serial.println(F("% of factory value"));
+	#endif // SERIAL_DEBUG
+}
+
 void setup() {
 	Wire.begin();
 	TWBR = 12; // enable 400 kb/s I2C "fast" mode
@@ -293,6 +414,14 @@ void setup() {
 	Serial.println("\"");
 	#endif // SERIAL_DEBUG
 
+	// Both IMUs and the BMP180 share the bus, so bring-up issues each stage to both IMUs back to back and lets their settle
+	// delays run at the same time. The BMP180 init and baseline reading happen inside the IMU reset delay.
+	if(!imu9250_main.reset(false))
+		error(ERR_MAIN_MPU9250_INIT_FAIL);
+	if(!imu9250_backup.reset(true))
+		error(ERR_BACK_MPU9250_INIT_FAIL);
+	uint32_t settle_start = millis();
+
 	if(!pressure.begin())
 		error(ERR_BMP180_INIT_FAIL);
 
@@ -305,40 +434,27 @@ void setup() {
 	Serial.print(F("baseline pressure: ")); Serial.print(baseline); Serial.println(F(" mb"));
 	#endif // SERIAL_DEBUG
 
-	// Start by performing self test and reporting values
-	float selfTest[6];
-	imu9250_main.self_test(selfTest);
+	settle(settle_start, MPU9250_RESET_DELAY);
+	imu9250_main.wake();
+	imu9250_backup.wake();
+	delay(MPU9250_WAKE_DELAY);
 
-	if (data_file) {
-		data_file.print(F("# ")); data_file.print((float)(millis() - start_time) / 1000.f, 3); data_file.print(F(" self test: "));
-		data_file.print(selfTest[0],1); data_file.print(str_space);
-		data_file.print(selfTest[1],1); data_file.print(str_space);
-		data_file.print(selfTest[2],1); data_file.print(str_space);
-		data_file.print(selfTest[3],1); data_file.print(str_space);
-		data_file.print(selfTest[4],1); data_file.print(str_space);
-		data_file.println(selfTest[5],1);
-		data_file.flush();
-	}
+	// Perform self test and report values. Each device's stimulus settles while the other one is being averaged.
+	MPU9250SelfTest st_main, st_backup;
+	float selfTest[6];
 
-	#ifdef SERIAL_DEBUG
-	Serial.print(F("main x-axis self test: acceleration trim within ")); Serial.print(selfTest[0],1); Serial.println(F("% of factory value"));
-	Serial.print(F("main y-axis self test: acceleration trim within ")); Serial.print(selfTest[1],1); Serial.println(F("% of factory value"));
-	Serial.print(F("main z-axis self test: acceleration trim within ")); Serial.print(selfTest[2],1); Serial.println(F("% of factory value"));
-	Serial.print(F("main x-axis self test: gyration trim within ")); Serial.print(selfTest[3],1); Serial.println(F("% of factory value"));
-	Serial.print(F("main y-axis self test: gyration trim within ")); Serial.print(selfTest[4],1); Serial.println(F("% of factory value"));
-	Serial.print(F("main z-axis self test: gyration trim within ")); Serial.print(selfTest[5],1); Serial.println(F("% of factory value"));
-	#endif // SERIAL_DEBUG
+	imu9250_main.self_test_begin(st_main);
+	imu9250_backup.self_test_begin(st_backup);
+	delay(MPU9250_SELF_TEST_DELAY);
 
-	imu9250_backup.self_test(selfTest);
+	imu9250_main.self_test_stimulus(st_main);
+	imu9250_backup.self_test_stimulus(st_backup);
+	delay(MPU9250_SELF_TEST_DELAY);
 
-	#ifdef SERIAL_DEBUG
-	Serial.print(F("backup x-axis self test: acceleration trim within ")); Serial.print(selfTest[0],1); Serial.println(F("% of factory value"));
-	Serial.print(F("backup y-axis self test: acceleration trim within ")); Serial.print(selfTest[1],1); Serial.println(F("% of factory value"));
-	Serial.print(F("backup z-axis self test: acceleration trim within ")); Serial.print(selfTest[2],1); Serial.println(F("% of factory value"));
-	Serial.print(F("backup x-axis self test: gyration trim within ")); Serial.print(selfTest[3],1); Serial.println(F("% of factory value"));
-	Serial.print(F("backup y-axis self test: gyration trim within ")); Serial.print(selfTest[4],1); Serial.println(F("% of factory value"));
-	Serial.print(F("backup z-axis self test: gyration trim within ")); Serial.print(selfTest[5],1); Serial.println(F("% of factory value"));
-	#endif // SERIAL_DEBUG
+	imu9250_main.self_test_end(st_main, selfTest);
+	reportSelfTest(F("main"), selfTest);
+	imu9250_backup.self_test_end(st_backup, selfTest);
+	reportSelfTest(F("backup"), selfTest);
 
 	/// Early results of the testing showed promising results, with the exact same results from the bias_get program at various
 	/// temperatures over the course of several hours. I've gone ahead and moved us away from the "calibrate every startup" method.
@@ -362,10 +478,18 @@ void setup() {
 	imu9250_main.set_bias(accel_bias_main, gyro_bias_main, mag_bias);
 	imu9250_backup.set_bias(accel_bias_backup, gyro_bias_backup, mag_bias);
 
-	if(!imu9250_main.init(AFS_16G, GFS_1000DPS, MFS_16BITS, MMODE_100HZ, false))
+	// configure() turns on I2C bypass, and both AK8963s answer at the same address. The main magnetometer has to read its
+	// fuse ROM calibration before the backup joins the bus, so these two stay serial.
+	imu9250_main.configure(AFS_16G, GFS_1000DPS);
+	delay(MPU9250_CONFIG_DELAY);
+
+	if(!imu9250_main.init_mag(MFS_16BITS, MMODE_100HZ))
 		error(ERR_MAIN_MPU9250_INIT_FAIL);
 
-	if(!imu9250_backup.init(AFS_2G, GFS_2000DPS, MFS_16BITS, MMODE_100HZ, true))
+	imu9250_backup.configure(AFS_2G, GFS_2000DPS);
+	delay(MPU9250_CONFIG_DELAY);
+
+	if(!imu9250_backup.init_mag(MFS_16BITS, MMODE_100HZ))
 		error(ERR_BACK_MPU9250_INIT_FAIL);
 
 	pinMode(RPI_SIGNAL_PIN, INPUT);
@@ -400,6 +524,7 @@ void setup() {
 /// Total measured cycle time using BMP180 temperature with all but cycle time serial printing disabled: ~29ms, about 34 Hz. Good enough.
 void loop() {
 	uint32_t now = millis();
+	profileBegin();
 
 	bool main_ready = false;
 	bool backup_ready = false;
@@ -412,16 +537,21 @@ void loop() {
 	}
 	
 	total_cycles++;
-	
+	profileMark(PROF_WAIT);
+
 	MPU9250Dataset data_main;// = {0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01};
 	imu9250_main.update(data_main); // cycle time impact: ~10ms (includes wait for MPU ready)
+	profileMark(PROF_MPU_MAIN);
 
 	MPU9250Dataset data_backup;// = {0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01, 0.01};
 	imu9250_backup.update(data_backup); // cycle time impact: ~10ms (includes wait for MPU ready)
+	uint32_t sample_us = micros();
+	profileMark(PROF_MPU_BACKUP);
 
 	// cycle time impact: ~13ms
 	BaroData bd = getPressure();
 	double a = pressure.altitude(bd.P, baseline);
+	profileMark(PROF_BARO);
 
 //	float magnitude_main = sqrt( (data_main.Ax * data_main.Ax) + (data_main.Ay * data_main.Ay) + (data_main.Az * data_main.Az) );
 //	float magnitude_backup = sqrt( (data_main.Ax * data_main.Ax) + (data_main.Ay * data_main.Ay) + (data_main.Az * data_main.Az) );
@@ -513,100 +643,30 @@ void loop() {
 	if(avg_data.mpu_backup.T >= 0) Serial.print(str_space); Serial.print(avg_data.mpu_backup.T, 1); Serial.print(F(" C   "));
 	if(avg_data.alt >= 0) Serial.print(str_space); Serial.print(avg_data.alt, 1); Serial.println(F(" ft   "));*/
 	#endif /// SERIOUSLY. This block adds ~30ms to our cycle time, costing us a whole 10 Hz. Turn it off for flight.
-
-	// TODO: this is the code that deploys the experiment. Currently, it's based only off the real time acceleration of the
-	// vertical axis: Z-axis on ground, perhaps X- or Y-axis when mounted in the rocket. There is also a check to ensure at
-	// least one second has elapsed since startup. The real time acceleration values could be changed to the average values,
-	// or some other method of filtering to protect against a single unexpected reading within the deployment range setting
-	// off the experiment. We should also include sanity checks of altitude and time elapsed... We know that 0g won't occur
-	// at 500 ft. off the ground, so we should be checking that we are above some safe minimums.
-	
-	if(flying) {
-		if((data_main.Ay < EXPERIMENT_POS_Y_THRESHOLD) || (data_backup.Ay < EXPERIMENT_POS_Y_THRESHOLD)) {
-			deployExperiment();
-		}
-	} else {
-		if((data_main.Ay > LIFTOFF_POS_Y_THRESHOLD) || (data_backup.Ay > LIFTOFF_POS_Y_THRESHOLD)) {
-			liftoff();
-		}
+	profileMark(PROF_SERIAL);
+
+	// This is the code that deploys the experiment. The vertical axis is Y when mounted in the rocket. Liftoff and deployment
+	// both need a few consecutive samples from either IMU, and deployment additionally needs EXPERIMENT_MIN_TIME since
+	// liftoff and EXPERIMENT_MIN_ALTITUDE_FT, since we know 0g won't occur at 500 ft. off the ground. See FlightState.cpp.
+	// Each action is only returned once, so the relays are driven exactly once.
+	FlightSample sample = {now, data_main.Ay, data_backup.Ay, (float)a};
+	switch(flight.update(sample)) {
+	case ACTION_LIFTOFF:
+		liftoff();
+		break;
+	case ACTION_DEPLOY:
+		deployExperiment(sample_us);
+		break;
+	default:
+		break;
 	}
+	profileMark(PROF_DECIDE);
 
 	// cycle time impact: ~9ms
 	if (data_file) {
-		data_file.print(total_cycles);
-		data_file.print(str_space);
-		data_file.print((float)(now - start_time) / 1000.f, 3);
-		data_file.print(str_space);
-		data_file.print(data_main.Ax, 2);
-		data_file.print(str_space);
-		data_file.print(data_main.Ay, 2);
-		data_file.print(str_space);
-		data_file.print(data_main.Az, 2);
-		data_file.print(str_space);
-		data_file.print(data_main.Gx, 1);
-		data_file.print(str_space);
-		data_file.print(data_main.Gy, 1);
-		data_file.print(str_space);
-		data_file.print(data_main.Gz, 1);
-		data_file.print(str_space);
-		data_file.print(data_main.T, 1);
-		data_file.print(str_space);
-		data_file.print(data_backup.Ax, 2);
-		data_file.print(str_space);
-		data_file.print(data_backup.Ay, 2);
-		data_file.print(str_space);
-		data_file.print(data_backup.Az, 2);
-		data_file.print(str_space);
-		data_file.print(data_backup.Gx, 1);
-		data_file.print(str_space);
-		data_file.print(data_backup.Gy, 1);
-		data_file.print(str_space);
-		data_file.print(data_backup.Gz, 1);
-		data_file.print(str_space);
-		data_file.print(data_backup.T, 1);
-		data_file.print(str_space);
-		data_file.print(bd.P, 1);
-		data_file.print(str_space);
-		data_file.print(bd.T, 1);
-		data_file.print(str_space);
-		data_file.print(a, 1);
-		data_file.print(str_space);
-/*		data_file.print(avg_data.mpu_main.Ax, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.Ay, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.Az, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.Gx, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.Gy, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.Gz, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_main.T, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Ax, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Ay, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Az, 2);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Gx, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Gy, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.Gz, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.mpu_backup.T, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.baro.P, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.baro.T, 1);
-		data_file.print(str_space);
-		data_file.print(avg_data.alt, 1);
-		data_file.print(str_space);*/
-		data_file.println(now - last_time);
+		profileBytes(logSample(data_file, total_cycles, (float)(now - start_time) / 1000.f, data_main, data_backup, bd, a, now - last_time));
 	}
+	profileMark(PROF_LOG);
 
 	#ifdef BUZZER_DEBUG
 	if(buzzer_timer > 0) {
@@ -623,6 +683,8 @@ void loop() {
 		data_file.flush();
 		cycle_count = 0;
 	}
+	profileMark(PROF_FLUSH);
+	profileReport();
 }
 
 BaroData getPressure() {
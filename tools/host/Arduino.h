@@ -0,0 +1,48 @@
+/**
+ * Host stand-in for the parts of the Arduino core the flight code uses, so it can be built and timed on Linux.
+ * Only what tools/ needs is here; this is not a general Arduino emulation.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+/// Same number formatting as the Arduino core's Print, including its "nan"/"inf"/"ovf" float output.
+class Print {
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+		virtual size_t write(const uint8_t* buffer, size_t size);
+
+		size_t print(const __FlashStringHelper* str) { return write((const char*)str); }
+		size_t print(const char* str) { return write(str); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(unsigned char n) { return printNumber(n); }
+		size_t print(int n) { return print((long)n); }
+		size_t print(unsigned int n) { return printNumber(n); }
+		size_t print(long n);
+		size_t print(unsigned long n) { return printNumber(n); }
+		size_t print(double number, int digits = 2) { return printFloat(number, digits); }
+
+		size_t println() { return write("\r\n"); }
+		template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+		template<typename T> size_t println(T value, int digits) { size_t n = print(value, digits); return n + println(); }
+
+	private:
+		size_t printNumber(unsigned long n);
+		size_t printFloat(double number, uint8_t digits);
+};
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,6 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h> // the real SPI.h pulls in the Arduino core, which MPU9250.cpp relies on
+
+#endif // HOST_SPI_H
@@ -0,0 +1,31 @@
+/**
+ * Host stand-in for the Arduino Wire library: a simulated I2C bus with a register bank per device address.
+ * Tests and benchmarks fill `registers` with canned values; writes land in the bank too.
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+	private:
+		uint8_t address = 0, pointer = 0;
+		uint8_t remaining = 0;
+		bool addressed = false; // the next write() selects the register pointer
+
+	public:
+		uint8_t registers[128][128];
+
+		void begin() {}
+		void beginTransmission(uint8_t address) { this->address = address & 0x7F; this->addressed = true; }
+		size_t write(uint8_t data);
+		uint8_t endTransmission(bool stop = true) { (void)stop; return 0; }
+		uint8_t requestFrom(uint8_t address, uint8_t count);
+		int available() { return this->remaining; }
+		int read();
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,104 @@
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <chrono>
+
+TwoWire Wire;
+
+static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+uint32_t micros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+/// Settle delays are for real silicon; on the host they would only slow the tools down.
+void delay(uint32_t) {}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t n = 0;
+	while(size--)
+		n += write(*buffer++);
+	return n;
+}
+
+size_t Print::print(long n) {
+	if(n < 0)
+		return print('-') + printNumber(-(unsigned long)n);
+	return printNumber(n);
+}
+
+size_t Print::printNumber(unsigned long n) {
+	char buf[8 * sizeof(long) + 1];
+	char* str = &buf[sizeof(buf) - 1];
+	*str = '\0';
+	do {
+		*--str = '0' + n % 10;
+		n /= 10;
+	} while(n);
+	return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+	if(isnan(number)) return print("nan");
+	if(isinf(number)) return print("inf");
+	if(number > 4294967040.0) return print("ovf"); // the largest value an unsigned long can hold after rounding
+	if(number < -4294967040.0) return print("ovf");
+
+	size_t n = 0;
+	if(number < 0.0) {
+		n += print('-');
+		number = -number;
+	}
+
+	// Round half up at the last printed digit, then print the integer part and one fraction digit at a time
+	double rounding = 0.5;
+	for(uint8_t i = 0; i < digits; i++)
+		rounding /= 10.0;
+	number += rounding;
+
+	unsigned long int_part = (unsigned long)number;
+	double remainder = number - (double)int_part;
+	n += print(int_part);
+
+	if(digits > 0)
+		n += print('.');
+
+	while(digits-- > 0) {
+		remainder *= 10.0;
+		unsigned int digit = (unsigned int)remainder;
+		n += print(digit);
+		remainder -= digit;
+	}
+
+	return n;
+}
+
+size_t TwoWire::write(uint8_t data) {
+	if(this->addressed) {
+		this->pointer = data & 0x7F;
+		this->addressed = false;
+	} else {
+		this->registers[this->address][this->pointer] = data;
+		this->pointer = (this->pointer + 1) & 0x7F;
+	}
+	return 1;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t count) {
+	this->address = address & 0x7F;
+	this->remaining = count;
+	return count;
+}
+
+int TwoWire::read() {
+	if(!this->remaining)
+		return -1;
+	this->remaining--;
+	uint8_t data = this->registers[this->address][this->pointer];
+	this->pointer = (this->pointer + 1) & 0x7F;
+	return data;
+}
@@ -0,0 +1,141 @@
+/**
+ * TECS Host Benchmarks
+ * Times the flight code's per-sample hot paths on Linux against the simulated I2C bus in tools/host, so changes can be
+ * compared before they get anywhere near the flight computer.
+ *
+ * Build and run with:	make -C tools bench
+ * Output:				CSV on stdout, one row per benchmark: benchmark,iterations,ns_per_op,bytes_per_sample
+ *
+ * These are host numbers: useful for comparing one change against another, not for predicting AVR cycle counts. For
+ * timings on the flight hardware, build the sketch with CYCLE_PROFILE and read the "# PROFILE" lines from the log.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "../FlightState.h"
+#include "../MPU9250.h"
+#include "../TelemetryLog.h"
+
+/// Log sink that counts bytes and copies them into a 512 byte buffer, like the SD library's block cache.
+class CountingSink : public Print {
+	public:
+		uint8_t block[512];
+		size_t count = 0;
+
+		size_t write(uint8_t c) override {
+			this->block[this->count++ & 511] = c;
+			return 1;
+		}
+};
+
+struct Result {
+	uint64_t iterations;
+	double ns_per_op;
+};
+
+const uint64_t ITERATIONS = 200000;
+const int REPEATS = 5;
+
+volatile float float_sink; // keeps the optimizer from dropping work whose result is otherwise unused
+
+/// Runs `op` ITERATIONS times, REPEATS times over, and keeps the fastest run.
+template<typename Op> static Result measure(Op op) {
+	double best = INFINITY;
+	for(int r = 0; r < REPEATS; r++) {
+		auto start = std::chrono::steady_clock::now();
+		for(uint64_t i = 0; i < ITERATIONS; i++)
+			op(i);
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if(ns < best)
+			best = ns;
+	}
+	return Result{ITERATIONS, best / ITERATIONS};
+}
+
+static void report(const char* name, const Result& result, double bytes_per_sample) {
+	printf("%s,%llu,%.1f,%.1f\n", name, (unsigned long long)result.iterations, result.ns_per_op, bytes_per_sample);
+}
+
+/// Canned register contents: a plausible on-pad reading for both IMUs, with WHO_AM_I and the data ready flags set.
+static void load_registers() {
+	const uint8_t sample[14] = {
+		0x00, 0x52, 0xFF, 0xC4, 0x07, 0xF0,	// accel x/y/z
+		0x0A, 0x10,							// temperature
+		0x00, 0x15, 0xFF, 0xEB, 0x00, 0x03	// gyro x/y/z
+	};
+	for(uint8_t address = 0x68; address <= 0x69; address++) {
+		memcpy(&Wire.registers[address][ACCEL_XOUT_H], sample, sizeof(sample));
+		Wire.registers[address][WHO_AM_I_MPU9250] = 0x71;
+		Wire.registers[address][INT_STATUS] = 0x01;
+	}
+	Wire.registers[AK8963_ADDRESS][AK8963_ST1] = 0x01;
+}
+
+/// Stand-in for SFE_BMP180::altitude(), which isn't vendored here; same formula.
+static double altitude(double P, double P0) {
+	return 44330.0 * (1 - pow(P / P0, 1 / 5.255));
+}
+
+int main() {
+	load_registers();
+
+	MPU9250 imu_main, imu_backup;
+	imu_main.reset(false);
+	imu_backup.reset(true);
+	imu_main.configure(AFS_16G, GFS_1000DPS);
+	imu_backup.configure(AFS_2G, GFS_2000DPS);
+
+	const FlightLimits limits = {2.0f, 3, 0.1f, 3, 4000, 500.f / 3.28084f};
+	const BaroData baro = {1001.7f, 24.1f};
+	const double baseline = 1013.25;
+
+	printf("benchmark,iterations,ns_per_op,bytes_per_sample\n");
+
+	// MPU9250::update(): burst read over the simulated bus plus raw to g/dps/C conversion
+	MPU9250Dataset data;
+	report("mpu_update", measure([&](uint64_t) {
+		imu_main.update(data);
+		float_sink = data.Ay;
+	}), 0);
+
+	// logSample(): the Print float formatting of one full log line
+	MPU9250Dataset data_main, data_backup;
+	imu_main.update(data_main);
+	imu_backup.update(data_backup);
+	CountingSink sink;
+	Result format = measure([&](uint64_t i) {
+		logSample(sink, i, i * 0.029f, data_main, data_backup, baro, 154.3, 29);
+	});
+	report("log_format", format, (double)sink.count / (REPEATS * ITERATIONS));
+
+	// FlightStateMachine::update(): flying and past the time minimum, so every guard is evaluated each sample
+	FlightStateMachine flight(limits);
+	for(uint32_t t = 0; t < 3 * 30; t += 30)
+		flight.update(FlightSample{t, 5.f, 5.f, 0.f});
+	report("flight_decide", measure([&](uint64_t i) {
+		flight.update(FlightSample{(uint32_t)(100000 + i * 30), 1.f, 1.f, 10.f});
+	}), 0);
+
+	// One loop() cycle, minus the BMP180 conversion waits and the SD card: both IMUs, altitude, decision and log line
+	FlightStateMachine cycle_flight(limits);
+	CountingSink cycle_sink;
+	Result cycle = measure([&](uint64_t i) {
+		uint32_t now = i * 30;
+		while(!imu_main.ready() || !imu_backup.ready()) {}
+		imu_main.update(data_main);
+		imu_backup.update(data_backup);
+		double a = altitude(baro.P, baseline);
+		cycle_flight.update(FlightSample{now, data_main.Ay, data_backup.Ay, (float)a});
+		logSample(cycle_sink, i, now / 1000.f, data_main, data_backup, baro, a, 30);
+	});
+	report("full_cycle", cycle, (double)cycle_sink.count / (REPEATS * ITERATIONS));
+
+	return 0;
+}
@@ -0,0 +1,427 @@
+/**
+ * TECS Flight Log Converter
+ * Parses a logNNNN.txt from the flight computer in one pass, prints a flight summary, and optionally writes the samples out
+ * as a columnar file for analysis.
+ *
+ * Linux only (mmap/mremap). The input is read once, start to finish; the summary and columnar output are built as it goes.
+ * Build with:	make -C tools tecs_log
+ * Usage:		tecs_log logNNNN.txt [out.tcol]
+ *
+ * Columnar file layout, all integers little endian:
+ *	TcolHeader
+ *	TcolColumn[header.columns]		column names, types and file offsets
+ *	column data						header.rows values per column, each column contiguous with no padding
+ *	TcolEvent[header.events]		at header.events_offset, the "#" lines with the row they came before
+ *	event text						at header.text_offset, referenced by TcolEvent::text_offset/text_len
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+enum ColumnType : uint32_t { COL_U32, COL_F32 };
+
+struct ColumnSpec {
+	const char* name;
+	ColumnType type;
+};
+
+/// One entry per field of a sample line, in the order loop() prints them.
+const ColumnSpec columns[] = {
+	{"cycle", COL_U32}, {"t", COL_F32},
+	{"main_ax", COL_F32}, {"main_ay", COL_F32}, {"main_az", COL_F32},
+	{"main_gx", COL_F32}, {"main_gy", COL_F32}, {"main_gz", COL_F32}, {"main_t", COL_F32},
+	{"backup_ax", COL_F32}, {"backup_ay", COL_F32}, {"backup_az", COL_F32},
+	{"backup_gx", COL_F32}, {"backup_gy", COL_F32}, {"backup_gz", COL_F32}, {"backup_t", COL_F32},
+	{"baro_p", COL_F32}, {"baro_t", COL_F32}, {"alt", COL_F32},
+	{"cycle_ms", COL_U32},
+};
+const uint32_t NUM_COLUMNS = sizeof(columns) / sizeof(columns[0]);
+
+// Field indices used by the summary
+const uint32_t F_T = 1, F_MAIN_A = 2, F_MAIN_G = 5, F_BACKUP_A = 9, F_BACKUP_G = 12, F_ALT = 18, F_CYCLE_MS = 19;
+
+const float M_TO_FT = 3.28084;
+
+const uint64_t TCOL_INITIAL_ROWS = 1 << 16;
+
+struct TcolHeader {
+	char magic[8];			// "TECSCOL1"
+	uint32_t version;
+	uint32_t columns;
+	uint64_t rows;
+	uint64_t events;
+	uint64_t events_offset;
+	uint64_t text_offset;
+};
+
+struct TcolColumn {
+	char name[16];
+	uint32_t type;			// ColumnType
+	uint32_t reserved;
+	uint64_t offset;
+};
+
+struct TcolEvent {
+	float t;				// seconds, as logged
+	uint32_t text_len;
+	uint64_t row;			// index of the first sample row after the event
+	uint64_t text_offset;
+};
+
+struct Event {
+	float t;
+	uint64_t row;
+	std::string text;
+};
+
+/// Running min/max/mean/variance, so the summary needs no second pass over the data.
+struct Stat {
+	uint64_t n = 0;
+	double mean = 0, m2 = 0;
+	double min = INFINITY, max = -INFINITY;
+	double at_max = 0;
+
+	void add(double x, double t = 0) {
+		if(isnan(x))
+			return;
+		n++;
+		double d = x - mean;
+		mean += d / n;
+		m2 += d * (x - mean);
+		if(x < min)
+			min = x;
+		if(x > max) {
+			max = x;
+			at_max = t;
+		}
+	}
+
+	double stddev() const { return n > 1 ? sqrt(m2 / (n - 1)) : 0; }
+};
+
+struct Summary {
+	uint64_t rows = 0, skipped = 0;
+	double first_t = NAN, last_t = NAN;
+	Stat cycle_ms;
+	Stat g_main, g_backup;
+	Stat alt;
+	Stat accel_dev[3], gyro_dev[3]; // |main - backup| per axis
+};
+
+/// Parses a number as printed by Arduino's Print: optional sign, digits, optional fraction. "nan", "inf" and "ovf" become NaN.
+/// Returns the position after the field, or nullptr if the field isn't a number.
+static const char* parse_number(const char* p, const char* end, double& out) {
+	bool neg = false;
+	if(p < end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+
+	if(p < end && (*p == 'n' || *p == 'i' || *p == 'o')) {
+		const char* word = p;
+		while(p < end && *p >= 'a' && *p <= 'z')
+			p++;
+		size_t len = p - word;
+		if(len == 3 && (!memcmp(word, "nan", 3) || !memcmp(word, "inf", 3) || !memcmp(word, "ovf", 3))) {
+			out = NAN;
+			return p;
+		}
+		return nullptr;
+	}
+
+	const char* digits = p;
+	uint64_t whole = 0;
+	while(p < end && *p >= '0' && *p <= '9')
+		whole = whole * 10 + (*p++ - '0');
+
+	double value = (double)whole;
+	if(p < end && *p == '.') {
+		p++;
+		uint64_t frac = 0;
+		double scale = 1;
+		while(p < end && *p >= '0' && *p <= '9') {
+			frac = frac * 10 + (*p++ - '0');
+			scale *= 10;
+		}
+		value += frac / scale;
+	}
+
+	if(p == digits)
+		return nullptr;
+
+	out = neg ? -value : value;
+	return p;
+}
+
+/// Splits one sample line into fields. Returns false if it doesn't have exactly NUM_COLUMNS numbers.
+static bool parse_sample(const char* p, const char* end, double* fields) {
+	uint32_t n = 0;
+	while(p < end) {
+		while(p < end && *p == ' ')
+			p++;
+		if(p == end)
+			break;
+		if(n == NUM_COLUMNS)
+			return false;
+		p = parse_number(p, end, fields[n++]);
+		if(!p || (p < end && *p != ' '))
+			return false;
+	}
+	return n == NUM_COLUMNS;
+}
+
+static void summarize(Summary& s, const double* f) {
+	double t = f[F_T];
+	if(s.rows == 0)
+		s.first_t = t;
+	else
+		s.cycle_ms.add(f[F_CYCLE_MS], t); // the first row's cycle time runs from the end of setup(), not a real cycle
+	s.last_t = t;
+	s.rows++;
+
+	const double* am = &f[F_MAIN_A];
+	const double* ab = &f[F_BACKUP_A];
+	s.g_main.add(sqrt(am[0] * am[0] + am[1] * am[1] + am[2] * am[2]), t);
+	s.g_backup.add(sqrt(ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2]), t);
+	s.alt.add(f[F_ALT], t);
+
+	for(int i = 0; i < 3; i++) {
+		s.accel_dev[i].add(fabs(f[F_MAIN_A + i] - f[F_BACKUP_A + i]), t);
+		s.gyro_dev[i].add(fabs(f[F_MAIN_G + i] - f[F_BACKUP_G + i]), t);
+	}
+}
+
+static double rms(const Stat& s) {
+	return sqrt(s.mean * s.mean + (s.n > 1 ? s.m2 / s.n : 0));
+}
+
+static const Event* find_event(const std::vector<Event>& events, const char* text) {
+	for(const Event& e : events)
+		if(e.text.find(text) != std::string::npos)
+			return &e;
+	return nullptr;
+}
+
+static void print_summary(const Summary& s, const std::vector<Event>& events) {
+	printf("rows: %llu\n", (unsigned long long)s.rows);
+	printf("skipped lines: %llu\n", (unsigned long long)s.skipped);
+	printf("events: %zu\n", events.size());
+	if(s.rows == 0)
+		return;
+
+	printf("duration s: %.3f\n", s.last_t - s.first_t);
+	printf("cycle ms: mean %.2f stddev %.2f min %.0f max %.0f (%.1f Hz)\n", s.cycle_ms.mean, s.cycle_ms.stddev(), s.cycle_ms.min, s.cycle_ms.max, s.cycle_ms.mean > 0 ? 1000. / s.cycle_ms.mean : 0.);
+	printf("max g main: %.2f at %.3f s\n", s.g_main.max, s.g_main.at_max);
+	printf("max g backup: %.2f at %.3f s\n", s.g_backup.max, s.g_backup.at_max);
+	printf("apogee: %.1f m (%.0f ft) at %.3f s\n", s.alt.max, s.alt.max * M_TO_FT, s.alt.at_max);
+
+	const char axes[] = "xyz";
+	for(int i = 0; i < 3; i++)
+		printf("main-backup accel %c: rms %.3f g max %.3f g at %.3f s\n", axes[i], rms(s.accel_dev[i]), s.accel_dev[i].max, s.accel_dev[i].at_max);
+	for(int i = 0; i < 3; i++)
+		printf("main-backup gyro %c: rms %.1f d/s max %.1f d/s at %.3f s\n", axes[i], rms(s.gyro_dev[i]), s.gyro_dev[i].max, s.gyro_dev[i].at_max);
+
+	if(const Event* e = find_event(events, "LIFTOFF DETECTED"))
+		printf("liftoff: %.3f s\n", e->t);
+	if(const Event* e = find_event(events, "EXPERIMENT DEPLOYED")) {
+		printf("deployed: %.3f s", e->t);
+		size_t at = e->text.find("latency us: ");
+		if(at != std::string::npos)
+			printf(", trigger to relay %s us", e->text.c_str() + at + strlen("latency us: "));
+		printf("\n");
+	}
+}
+
+/// Columnar output, written straight into a mapping of the output file. The number of samples isn't known until the
+/// input has been read, so the mapping starts at TCOL_INITIAL_ROWS per column and doubles as needed, moving the columns
+/// apart. finish() packs the columns down to the rows actually written before appending the event index.
+struct TcolWriter {
+	int fd = -1;
+	uint8_t* map = nullptr;
+	size_t map_size = 0;
+	uint64_t capacity = 0;	// rows each column has room for
+	uint64_t rows = 0;		// rows written so far
+	uint64_t file_size = 0;
+
+	static const uint64_t data_start = sizeof(TcolHeader) + NUM_COLUMNS * sizeof(TcolColumn);
+
+	uint8_t* column(uint32_t i, uint64_t stride) { return this->map + data_start + i * stride * 4; }
+
+	bool open(const char* path) {
+		this->fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		return this->fd >= 0 && grow(TCOL_INITIAL_ROWS);
+	}
+
+	bool grow(uint64_t new_capacity) {
+		size_t new_size = data_start + NUM_COLUMNS * new_capacity * 4;
+		if(ftruncate(this->fd, new_size) != 0)
+			return false;
+
+		void* m = this->map ? mremap(this->map, this->map_size, new_size, MREMAP_MAYMOVE) : mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+		if(m == MAP_FAILED)
+			return false;
+		this->map = (uint8_t*)m;
+		this->map_size = new_size;
+
+		// Move the columns to their new starts, last one first so nothing is overwritten before it has moved
+		for(uint32_t i = NUM_COLUMNS - 1; i > 0; i--)
+			memmove(column(i, new_capacity), column(i, this->capacity), this->rows * 4);
+		this->capacity = new_capacity;
+		return true;
+	}
+
+	bool put(const double* fields) {
+		if(this->rows == this->capacity && !grow(this->capacity * 2))
+			return false;
+
+		for(uint32_t i = 0; i < NUM_COLUMNS; i++) {
+			uint8_t* dst = column(i, this->capacity) + this->rows * 4;
+			if(columns[i].type == COL_U32) {
+				uint32_t v = isnan(fields[i]) ? 0 : (uint32_t)fields[i];
+				memcpy(dst, &v, 4);
+			} else {
+				float v = (float)fields[i];
+				memcpy(dst, &v, 4);
+			}
+		}
+		this->rows++;
+		return true;
+	}
+
+	bool finish(const std::vector<Event>& events) {
+		// Pack the columns end to end, first one first since each only moves towards the start of the file
+		for(uint32_t i = 1; i < NUM_COLUMNS; i++)
+			memmove(column(i, this->rows), column(i, this->capacity), this->rows * 4);
+
+		TcolHeader header;
+		memcpy(header.magic, "TECSCOL1", 8);
+		header.version = 1;
+		header.columns = NUM_COLUMNS;
+		header.rows = this->rows;
+		header.events = events.size();
+		header.events_offset = data_start + NUM_COLUMNS * this->rows * 4;
+		header.text_offset = header.events_offset + events.size() * sizeof(TcolEvent);
+		memcpy(this->map, &header, sizeof(header));
+
+		for(uint32_t i = 0; i < NUM_COLUMNS; i++) {
+			TcolColumn col;
+			memset(&col, 0, sizeof(col));
+			strncpy(col.name, columns[i].name, sizeof(col.name) - 1);
+			col.type = columns[i].type;
+			col.offset = data_start + i * this->rows * 4;
+			memcpy(this->map + sizeof(TcolHeader) + i * sizeof(TcolColumn), &col, sizeof(col));
+		}
+
+		munmap(this->map, this->map_size);
+		this->map = nullptr;
+
+		std::vector<TcolEvent> index;
+		std::string text;
+		for(const Event& e : events) {
+			TcolEvent te;
+			te.t = e.t;
+			te.text_len = e.text.size();
+			te.row = e.row;
+			te.text_offset = text.size();
+			index.push_back(te);
+			text += e.text;
+		}
+
+		this->file_size = header.text_offset + text.size();
+		bool ok = ftruncate(this->fd, this->file_size) == 0
+			&& pwrite(this->fd, index.data(), index.size() * sizeof(TcolEvent), header.events_offset) == (ssize_t)(index.size() * sizeof(TcolEvent))
+			&& pwrite(this->fd, text.data(), text.size(), header.text_offset) == (ssize_t)text.size();
+		return (close(this->fd) == 0) && ok;
+	}
+};
+
+int main(int argc, char** argv) {
+	if(argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s logNNNN.txt [out.tcol]\n", argv[0]);
+		return 2;
+	}
+
+	int fd = open(argv[1], O_RDONLY);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) != 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	size_t size = st.st_size;
+	const char* data = "";
+	if(size > 0) {
+		data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED) {
+			perror(argv[1]);
+			return 1;
+		}
+		madvise((void*)data, size, MADV_SEQUENTIAL);
+	}
+	const char* end = data + size;
+
+	TcolWriter out;
+	if(argc == 3) {
+		if(!out.open(argv[2])) {
+			perror(argv[2]);
+			return 1;
+		}
+	}
+
+	Summary summary;
+	std::vector<Event> events;
+	double fields[NUM_COLUMNS];
+
+	for(const char* line = data; line < end; ) {
+		const char* eol = (const char*)memchr(line, '\n', end - line);
+		if(!eol)
+			eol = end;
+		const char* next = eol + (eol < end);
+		if(eol > line && eol[-1] == '\r') // println() ends lines with \r\n
+			eol--;
+
+		if(line < eol && *line == '#') {
+			// "# <seconds> <text>" from liftoff(), warning(), error() and friends
+			const char* p = line + 1;
+			while(p < eol && *p == ' ')
+				p++;
+			double t = NAN;
+			const char* after = parse_number(p, eol, t);
+			if(after) {
+				p = after;
+				while(p < eol && *p == ' ')
+					p++;
+			}
+			events.push_back(Event{(float)t, summary.rows, std::string(p, eol)});
+		} else if(line < eol) {
+			if(parse_sample(line, eol, fields)) {
+				if(out.map && !out.put(fields)) {
+					perror(argv[2]);
+					return 1;
+				}
+				summarize(summary, fields);
+			} else {
+				summary.skipped++; // usually the last line, cut short by power loss
+			}
+		}
+
+		line = next;
+	}
+
+	if(out.map && !out.finish(events)) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	print_summary(summary, events);
+	if(argc == 3)
+		printf("columnar bytes: %llu\n", (unsigned long long)out.file_size);
+	return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * Trace tests for FlightStateMachine. Each test feeds a sensor trace through update() and checks which action fires at
+ * which sample index. Run with: make -C tools test
+ */
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "../../FlightState.h"
+
+const uint32_t CYCLE_MS = 30;
+
+// Small numbers so the traces stay short: 3 samples to confirm, 300 ms after liftoff, 100 m up
+const FlightLimits limits = {2.0f, 3, 0.1f, 3, 300, 100.f};
+
+struct Fired {
+	size_t index;
+	FlightAction action;
+};
+
+static int failures = 0;
+
+/// Builds samples one cycle apart, starting at t = 0.
+struct Trace {
+	std::vector<FlightSample> samples;
+
+	Trace& add(float accel_main, float accel_backup, float alt, size_t count = 1) {
+		for(size_t i = 0; i < count; i++) {
+			uint32_t t = this->samples.size() * CYCLE_MS;
+			this->samples.push_back(FlightSample{t, accel_main, accel_backup, alt});
+		}
+		return *this;
+	}
+
+	size_t next() const { return this->samples.size(); }
+};
+
+static std::vector<Fired> run(const Trace& trace) {
+	FlightStateMachine fsm(limits);
+	std::vector<Fired> fired;
+	for(size_t i = 0; i < trace.samples.size(); i++) {
+		FlightAction action = fsm.update(trace.samples[i]);
+		if(action != ACTION_NONE)
+			fired.push_back(Fired{i, action});
+	}
+	return fired;
+}
+
+static void expect(const char* name, const Trace& trace, const std::vector<Fired>& expected) {
+	std::vector<Fired> fired = run(trace);
+	bool ok = fired.size() == expected.size();
+	for(size_t i = 0; ok && i < fired.size(); i++)
+		ok = (fired[i].index == expected[i].index) && (fired[i].action == expected[i].action);
+
+	printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+	if(ok)
+		return;
+
+	failures++;
+	printf("  expected:");
+	for(const Fired& f : expected)
+		printf(" %d@%zu", f.action, f.index);
+	printf("\n  fired:   ");
+	for(const Fired& f : fired)
+		printf(" %d@%zu", f.action, f.index);
+	printf("\n");
+}
+
+int main() {
+	{
+		Trace t;
+		t.add(1.f, 1.f, 0.f, 10);
+		t.add(8.f, 8.f, 0.f);			// a single spike
+		t.add(1.f, 1.f, 0.f, 10);
+		t.add(8.f, 8.f, 0.f, 2);		// two in a row is still not enough
+		t.add(1.f, 1.f, 0.f, 10);
+		expect("single high-g spike does not trigger liftoff", t, {});
+	}
+
+	{
+		Trace t;
+		t.add(1.f, 1.f, 0.f, 10);
+		size_t liftoff = t.next() + 2;
+		t.add(5.f, 5.f, 0.f, 5);
+		expect("three sustained samples trigger liftoff on the third", t, {{liftoff, ACTION_LIFTOFF}});
+	}
+
+	{
+		Trace t;
+		t.add(1.f, 1.f, 0.f, 5);
+		size_t liftoff = t.next() + 2;
+		t.add(1.f, 5.f, 0.f, 3);		// only the backup sees it
+		expect("backup IMU alone can confirm liftoff", t, {{liftoff, ACTION_LIFTOFF}});
+	}
+
+	{
+		Trace t;
+		t.add(1.f, 1.f, 0.f, 5);
+		t.add(5.f, 1.f, 0.f);
+		t.add(1.f, 5.f, 0.f);
+		size_t liftoff = t.next();
+		t.add(5.f, 1.f, 0.f);			// alternating IMUs still counts as sustained
+		t.add(1.f, 1.f, 0.f, 5);
+		expect("sustain counter takes either IMU on each sample", t, {{liftoff, ACTION_LIFTOFF}});
+	}
+
+	{
+		Trace t;
+		t.add(5.f, 1.f, 0.f);
+		t.add(1.f, 5.f, 0.f);
+		t.add(1.f, 1.f, 0.f);			// neither IMU, so the count starts over
+		t.add(5.f, 1.f, 0.f);
+		t.add(1.f, 5.f, 0.f);
+		t.add(1.f, 1.f, 0.f, 5);
+		expect("a sample where neither IMU agrees resets the count", t, {});
+	}
+
+	{
+		// Liftoff at sample 2 (t = 60 ms), so deployment is allowed from t = 360 ms, sample 12
+		Trace t;
+		t.add(5.f, 5.f, 0.f, 3);
+		t.add(0.f, 0.f, 500.f, 9);		// low g and high enough, but too soon
+		size_t deploy = t.next();
+		t.add(0.f, 0.f, 500.f, 5);
+		expect("no deployment before deploy_min_time", t, {{2, ACTION_LIFTOFF}, {deploy, ACTION_DEPLOY}});
+	}
+
+	{
+		Trace t;
+		t.add(5.f, 5.f, 0.f, 3);
+		t.add(0.f, 0.f, 50.f, 30);		// long enough and low g, but below deploy_min_alt
+		size_t deploy = t.next();
+		t.add(0.f, 0.f, 150.f, 5);
+		expect("no deployment below deploy_min_alt", t, {{2, ACTION_LIFTOFF}, {deploy, ACTION_DEPLOY}});
+	}
+
+	{
+		Trace t;
+		t.add(5.f, 5.f, 0.f, 3);
+		t.add(1.f, 1.f, 500.f, 20);
+		t.add(0.f, 1.f, 500.f, 2);
+		size_t deploy = t.next();
+		t.add(1.f, 0.f, 500.f);			// third low-g sample in a row, from the other IMU
+		t.add(0.f, 0.f, 500.f, 100);	// the condition keeps holding
+		t.add(5.f, 5.f, 500.f, 10);		// and liftoff conditions come back
+		expect("deployment fires once and nothing fires after", t, {{2, ACTION_LIFTOFF}, {deploy, ACTION_DEPLOY}});
+	}
+
+	return failures ? 1 : 0;
+}